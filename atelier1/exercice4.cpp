@@ -7,57 +7,125 @@
 #include <chrono>
 #include <map>
 #include <random>
+#include <thread>
+#include <future>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <memory_resource>
+#include <string_view>
+#include <unordered_set>
+#include <deque>
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <new>
 #include <openssl/sha.h>
 
 using namespace std;
 
 //  SHA256 
-string sha256(const string &data) {
+using HexDigest = array<char, 2 * SHA256_DIGEST_LENGTH>;
+
+// Empreinte hexadecimale ecrite dans un tampon fixe (aucune allocation).
+void sha256Hex(const void *data, size_t len, HexDigest &out) {
+    static const char *lut = "0123456789abcdef";
     unsigned char hash[SHA256_DIGEST_LENGTH];
-    SHA256((unsigned char*)data.c_str(), data.size(), hash);
-    stringstream ss;
-    for (int i = 0; i < SHA256_DIGEST_LENGTH; ++i)
-        ss << hex << setw(2) << setfill('0') << (int)hash[i];
-    return ss.str();
+    SHA256((const unsigned char*)data, len, hash);
+    for (int i = 0; i < SHA256_DIGEST_LENGTH; ++i) {
+        out[2*i] = lut[hash[i] >> 4];
+        out[2*i + 1] = lut[hash[i] & 0xF];
+    }
+}
+
+string sha256(const string &data) {
+    HexDigest h;
+    sha256Hex(data.data(), data.size(), h);
+    return string(h.data(), h.size());
+}
+
+//  Comptes 
+// Chaque nom de compte est stocke une seule fois ; les transactions n'en
+// gardent qu'une vue. deque : les chaines ne sont jamais deplacees.
+string_view internAccount(string_view name) {
+    static deque<string> storage;
+    static unordered_set<string_view> names;
+    static mutex m;
+    lock_guard<mutex> lk(m);
+    auto it = names.find(name);
+    if (it != names.end()) return *it;
+    storage.emplace_back(name);
+    return *names.insert(storage.back()).first;
 }
 
 //  Transaction 
-struct Transaction {
-    string sender;
-    string receiver;
-    double amount;
+// Trivialement copiable : les noms sont internes des la construction, une
+// Transaction ne peut donc pas pointer vers une chaine temporaire.
+class Transaction {
+    string_view sender_;
+    string_view receiver_;
+    double amount_;
+
+public:
+    Transaction(string_view sender, string_view receiver, double amount)
+        : sender_(internAccount(sender)), receiver_(internAccount(receiver)), amount_(amount) {}
+
+    string_view sender() const { return sender_; }
+    string_view receiver() const { return receiver_; }
+    double amount() const { return amount_; }
 };
 
 //  Merkle Tree 
-string computeMerkleRoot(vector<Transaction> &txs) {
-    if (txs.empty()) return "";
-    vector<string> hashes;
-    for (auto &t : txs)
-        hashes.push_back(sha256(t.sender + t.receiver + to_string(t.amount)));
-
-    while (hashes.size() > 1) {
-        vector<string> newLevel;
-        for (size_t i = 0; i < hashes.size(); i += 2) {
-            string left = hashes[i];
-            string right = (i + 1 < hashes.size()) ? hashes[i + 1] : left;
-            newLevel.push_back(sha256(left + right));
+string computeMerkleRoot(const Transaction *txs, size_t n) {
+    if (n == 0) return "";
+    static thread_local vector<HexDigest> hashes; // reutilise d'un bloc a l'autre
+    hashes.resize(n);
+    string leaf;
+    char amount[64];
+    for (size_t i = 0; i < n; ++i) {
+        int len = snprintf(amount, sizeof(amount), "%f", txs[i].amount()); // comme to_string
+        leaf.assign(txs[i].sender()).append(txs[i].receiver()).append(amount, len);
+        sha256Hex(leaf.data(), leaf.size(), hashes[i]);
+    }
+
+    // Chaque niveau est calcule en place dans la premiere moitie du tableau.
+    char buf[2 * sizeof(HexDigest)];
+    while (n > 1) {
+        size_t m = 0;
+        for (size_t i = 0; i < n; i += 2) {
+            const HexDigest &left = hashes[i];
+            const HexDigest &right = (i + 1 < n) ? hashes[i + 1] : left;
+            memcpy(buf, left.data(), left.size());
+            memcpy(buf + left.size(), right.data(), right.size());
+            sha256Hex(buf, sizeof(buf), hashes[m++]);
         }
-        hashes = newLevel;
+        n = m;
     }
-    return hashes[0];
+    return string(hashes[0].data(), hashes[0].size());
 }
 
 //  Proof of Work 
-string mineBlock(string previousHash, string merkleRoot, int difficulty) {
+// Recherche du nonce ; renvoie false si *cancel passe a true avant la fin.
+bool tryMineBlock(const string &previousHash, const string &merkleRoot, int difficulty,
+                  string &hash, int &nonce, const atomic<bool> *cancel = nullptr) {
     string prefix(difficulty, '0');
+    nonce = 0;
+    do {
+        if (cancel && cancel->load(memory_order_relaxed)) return false;
+        hash = sha256(previousHash + merkleRoot + to_string(nonce));
+        nonce++;
+    } while (hash.compare(0, difficulty, prefix) != 0);
+    return true;
+}
+
+string mineBlock(string previousHash, string merkleRoot, int difficulty) {
     int nonce = 0;
     string hash;
     auto start = chrono::high_resolution_clock::now();
 
-    do {
-        hash = sha256(previousHash + merkleRoot + to_string(nonce));
-        nonce++;
-    } while (hash.substr(0, difficulty) != prefix);
+    tryMineBlock(previousHash, merkleRoot, difficulty, hash, nonce);
 
     auto end = chrono::high_resolution_clock::now();
     chrono::duration<double> duration = end - start;
@@ -91,47 +159,66 @@ string validateBlockPOS(string previousHash, string merkleRoot, map<string,int>
 }
 
 //  Block 
+// Les transactions vivent dans l'arena du bloc (une seule allocation pour
+// tout le bloc). Le bloc n'est que deplacable : il passe a la chaine sans copie.
 class Block {
+    unique_ptr<pmr::monotonic_buffer_resource> arena; // adresse stable apres deplacement
+
 public:
     int index;
     string previousHash;
     string hash;
     string merkleRoot;
-    vector<Transaction> transactions;
+    pmr::vector<Transaction> transactions;
     time_t timestamp;
 
-    Block(int idx, string prev, vector<Transaction> txs)
-        : index(idx), previousHash(prev), transactions(txs) {
+    Block(int idx, string prev, const vector<Transaction> &txs)
+        : arena(make_unique<pmr::monotonic_buffer_resource>(
+              max<size_t>(1, txs.size()) * sizeof(Transaction))),
+          index(idx), previousHash(move(prev)), transactions(txs.begin(), txs.end(), arena.get()) {
         timestamp = time(nullptr);
-        merkleRoot = computeMerkleRoot(transactions);
+        merkleRoot = computeMerkleRoot(transactions.data(), transactions.size());
     }
+
+    Block(Block&&) = default;
+    Block(const Block&) = delete;
+    Block& operator=(const Block&) = delete;
+    Block& operator=(Block&&) = delete; // les transactions restent liees a leur arena
 };
 
+static_assert(is_nothrow_move_constructible<Block>::value,
+              "vector<Block> doit deplacer (et non copier) lors d'une reallocation");
+
 //  Blockchain 
 class Blockchain {
 public:
     vector<Block> chain;
 
     Blockchain() {
-        vector<Transaction> genesisTx = {{"System","Genesis",0}};
-        chain.push_back(Block(0,"0",genesisTx));
+        chain.emplace_back(0, "0", vector<Transaction>{{"System","Genesis",0}});
         chain[0].hash = sha256("Genesis Block");
     }
 
-    Block createBlock(vector<Transaction> txs) {
+    Block createBlock(const vector<Transaction> &txs) {
         return Block(chain.size(), chain.back().hash, txs);
     }
 
-    void addBlockPOW(vector<Transaction> txs, int difficulty) {
+    // Rattache un bloc prepare a l'avance (Merkle root deja calcule) au sommet actuel.
+    void linkToTip(Block &b) {
+        b.index = chain.size();
+        b.previousHash = chain.back().hash;
+    }
+
+    void addBlockPOW(const vector<Transaction> &txs, int difficulty) {
         Block newBlock = createBlock(txs);
         newBlock.hash = mineBlock(newBlock.previousHash, newBlock.merkleRoot, difficulty);
-        chain.push_back(newBlock);
+        chain.push_back(move(newBlock));
     }
 
-    void addBlockPOS(vector<Transaction> txs, map<string,int> &stakes) {
+    void addBlockPOS(const vector<Transaction> &txs, map<string,int> &stakes) {
         Block newBlock = createBlock(txs);
         newBlock.hash = validateBlockPOS(newBlock.previousHash, newBlock.merkleRoot, stakes);
-        chain.push_back(newBlock);
+        chain.push_back(move(newBlock));
     }
 
     void showChain() {
@@ -147,6 +234,248 @@ public:
     }
 };
 
+//  Service de minage asynchrone 
+// Un thread mine le dernier bloc soumis pendant que l'appelant continue
+// (reception de transactions, validation, preparation du bloc suivant).
+// Une nouvelle soumission (nouveau sommet ou meilleur bloc) ou cancel()
+// interrompt le travail en cours : son future renvoie alors found == false.
+class MiningService {
+public:
+    struct Result {
+        bool found;
+        Block block;
+        int nonce = 0; // hash essayes
+    };
+
+    explicit MiningService(int difficulty) : difficulty(difficulty) {
+        worker = thread([this] { run(); });
+    }
+
+    ~MiningService() {
+        {
+            lock_guard<mutex> lk(m);
+            stopping = true;
+            if (current) current->store(true);
+        }
+        cv.notify_one();
+        worker.join();
+    }
+
+    MiningService(const MiningService&) = delete;
+    MiningService& operator=(const MiningService&) = delete;
+
+    future<Result> submit(Block b) {
+        auto job = make_unique<Job>(Job{move(b), make_shared<atomic<bool>>(false), {}});
+        future<Result> f = job->done.get_future();
+        {
+            lock_guard<mutex> lk(m);
+            dropLocked();
+            current = job->cancel;
+            pending = move(job);
+        }
+        cv.notify_one();
+        return f;
+    }
+
+    void cancel() {
+        lock_guard<mutex> lk(m);
+        dropLocked();
+    }
+
+    // Attend que le thread mine le dernier bloc soumis.
+    void waitUntilMining() {
+        unique_lock<mutex> lk(m);
+        started.wait(lk, [this] { return mining && !pending; });
+    }
+
+private:
+    struct Job {
+        Block block;
+        shared_ptr<atomic<bool>> cancel;
+        promise<Result> done;
+    };
+
+    void dropLocked() {
+        if (current) current->store(true);
+        if (pending) {
+            pending->done.set_value(Result{false, move(pending->block)});
+            pending.reset();
+        }
+    }
+
+    void run() {
+        for (;;) {
+            unique_ptr<Job> job;
+            {
+                unique_lock<mutex> lk(m);
+                cv.wait(lk, [this] { return stopping || pending; });
+                if (stopping) break;
+                job = move(pending);
+                mining = true;
+            }
+            started.notify_all();
+            Block &b = job->block;
+            int nonce = 0;
+            bool found = tryMineBlock(b.previousHash, b.merkleRoot, difficulty,
+                                      b.hash, nonce, job->cancel.get());
+            {
+                lock_guard<mutex> lk(m);
+                mining = false;
+            }
+            job->done.set_value(Result{found, move(b), nonce});
+        }
+        lock_guard<mutex> lk(m);
+        if (pending) pending->done.set_value(Result{false, move(pending->block)});
+    }
+
+    int difficulty;
+    mutex m;
+    condition_variable cv;
+    condition_variable started;
+    unique_ptr<Job> pending;
+    shared_ptr<atomic<bool>> current;
+    bool stopping = false;
+    bool mining = false;
+    thread worker;
+};
+
+#ifdef ALLOC_BENCH
+//  Benchmark : octets alloues par transaction 
+// g++ -DALLOC_BENCH exercice4.cpp -o bench4 -lcrypto -lssl -pthread
+// Le compteur remplace operator new pour tout le programme : il n'existe que
+// dans ce binaire de mesure.
+static atomic<size_t> allocatedBytes{0};
+
+[[gnu::noinline]] void* operator new(size_t n) {
+    allocatedBytes.fetch_add(n, memory_order_relaxed);
+    if (void *p = malloc(n ? n : 1)) return p;
+    throw bad_alloc();
+}
+[[gnu::noinline]] void* operator new(size_t n, align_val_t al) {
+    allocatedBytes.fetch_add(n, memory_order_relaxed);
+    size_t a = max(size_t(al), sizeof(void*));
+    if (void *p = aligned_alloc(a, (max<size_t>(n, 1) + a - 1) / a * a)) return p;
+    throw bad_alloc();
+}
+[[gnu::noinline]] void operator delete(void *p) noexcept { free(p); }
+[[gnu::noinline]] void operator delete(void *p, size_t) noexcept { free(p); }
+[[gnu::noinline]] void operator delete(void *p, align_val_t) noexcept { free(p); }
+[[gnu::noinline]] void operator delete(void *p, size_t, align_val_t) noexcept { free(p); }
+
+// Ancienne construction, conservee telle quelle pour la comparaison :
+// std::string par compte, passages par valeur, copie du bloc dans la chaine.
+namespace legacy {
+    string sha256(const string &data) {
+        unsigned char hash[SHA256_DIGEST_LENGTH];
+        SHA256((unsigned char*)data.c_str(), data.size(), hash);
+        stringstream ss;
+        for (int i = 0; i < SHA256_DIGEST_LENGTH; ++i)
+            ss << hex << setw(2) << setfill('0') << (int)hash[i];
+        return ss.str();
+    }
+
+    struct Transaction {
+        string sender;
+        string receiver;
+        double amount;
+    };
+
+    string computeMerkleRoot(vector<Transaction> &txs) {
+        if (txs.empty()) return "";
+        vector<string> hashes;
+        for (auto &t : txs)
+            hashes.push_back(sha256(t.sender + t.receiver + to_string(t.amount)));
+
+        while (hashes.size() > 1) {
+            vector<string> newLevel;
+            for (size_t i = 0; i < hashes.size(); i += 2) {
+                string left = hashes[i];
+                string right = (i + 1 < hashes.size()) ? hashes[i + 1] : left;
+                newLevel.push_back(sha256(left + right));
+            }
+            hashes = newLevel;
+        }
+        return hashes[0];
+    }
+
+    class Block {
+    public:
+        int index;
+        string previousHash;
+        string hash;
+        string merkleRoot;
+        vector<Transaction> transactions;
+        time_t timestamp;
+
+        Block(int idx, string prev, vector<Transaction> txs)
+            : index(idx), previousHash(prev), transactions(txs) {
+            timestamp = time(nullptr);
+            merkleRoot = computeMerkleRoot(transactions);
+        }
+    };
+
+    class Blockchain {
+    public:
+        vector<Block> chain;
+
+        Blockchain() {
+            vector<Transaction> genesisTx = {{"System","Genesis",0}};
+            chain.push_back(Block(0,"0",genesisTx));
+            chain[0].hash = sha256("Genesis Block");
+        }
+
+        Block createBlock(vector<Transaction> txs) {
+            return Block(chain.size(), chain.back().hash, txs);
+        }
+    };
+}
+
+// Memes comptes et memes transactions pour les deux chemins. Seuls
+// createBlock et l'ajout a la chaine sont mesures, pas la preparation des
+// transactions d'entree.
+static string benchAccount(size_t i) { return "account-" + to_string(100000 + i % 1000); }
+
+double legacyBytesPerTransaction(size_t blocks, size_t txPerBlock) {
+    legacy::Blockchain bc;
+    size_t total = 0;
+    for (size_t k = 0; k < blocks; ++k) {
+        vector<legacy::Transaction> txs;
+        txs.reserve(txPerBlock);
+        for (size_t i = 0; i < txPerBlock; ++i)
+            txs.push_back({benchAccount(i*7 + k), benchAccount(i*13 + k + 1), double(i % 100)});
+        size_t before = allocatedBytes.load();
+        legacy::Block b = bc.createBlock(txs);
+        b.hash = legacy::sha256(b.previousHash + b.merkleRoot);
+        bc.chain.push_back(b);
+        total += allocatedBytes.load() - before;
+    }
+    return double(total) / (blocks * txPerBlock);
+}
+
+double bytesPerTransaction(size_t blocks, size_t txPerBlock) {
+    Blockchain bc;
+    size_t total = 0;
+    for (size_t k = 0; k < blocks; ++k) {
+        vector<Transaction> txs;
+        txs.reserve(txPerBlock);
+        for (size_t i = 0; i < txPerBlock; ++i)
+            txs.emplace_back(benchAccount(i*7 + k), benchAccount(i*13 + k + 1), double(i % 100));
+        size_t before = allocatedBytes.load();
+        Block b = bc.createBlock(txs);
+        b.hash = sha256(b.previousHash + b.merkleRoot);
+        bc.chain.push_back(move(b));
+        total += allocatedBytes.load() - before;
+    }
+    return double(total) / (blocks * txPerBlock);
+}
+
+int main() {
+    cout << "Octets alloues par transaction (20 blocs x 1000 tx)\n"
+         << " avant (par valeur, std::string par compte) : " << legacyBytesPerTransaction(20, 1000) << "\n"
+         << " apres (arena par bloc, comptes internes)   : " << bytesPerTransaction(20, 1000) << endl;
+    return 0;
+}
+#else
 //  MAIN 
 int main() {
     Blockchain bc;
@@ -162,7 +491,50 @@ int main() {
     cout << "\n Ajout de blocs avec Proof of Stake \n";
     bc.addBlockPOS(tx2, stakes);
 
+    cout << "\n Minage asynchrone (PoW en arriere-plan) \n";
+    {
+        MiningService miner(4);
+        vector<vector<Transaction>> pool = {
+            {{"Sara","Alice",3}},
+            {{"Charlie","Youssef",7},{"Alice","Ali",1}},
+            {{"Bob","Sara",2}}
+        };
+
+        // Un bloc concurrent arrive : le travail en cours est abandonne.
+        vector<Transaction> better = pool[0];
+        better.emplace_back("Ali", "Bob", 4);
+
+        // Un meilleur bloc arrive pendant que le thread mine le premier :
+        // le travail en cours est abandonne puis le minage repart.
+        auto stale = miner.submit(bc.createBlock(pool[0]));
+        miner.waitUntilMining();
+        auto t0 = chrono::high_resolution_clock::now();
+        auto fut = miner.submit(bc.createBlock(better));
+        auto s = stale.get();
+        chrono::duration<double, micro> cancelTime = chrono::high_resolution_clock::now() - t0;
+        miner.waitUntilMining();
+        chrono::duration<double, micro> restartTime = chrono::high_resolution_clock::now() - t0;
+        cout << " Travail obsolete " << (s.found ? "termine avant l'annulation" : "annule")
+             << " apres " << s.nonce << " hash : annulation " << cancelTime.count()
+             << " us, reprise " << restartTime.count() << " us" << endl;
+
+        for (size_t i = 1; i < pool.size(); ++i) {
+            // Merkle root du bloc suivant calcule pendant le minage du precedent
+            Block next = bc.createBlock(pool[i]);
+            auto r = fut.get();
+            if (!r.found) break; // annule : le bloc n'a pas ete mine
+            bc.chain.push_back(move(r.block));
+            bc.linkToTip(next);
+            fut = miner.submit(move(next));
+        }
+        if (fut.valid()) {
+            auto r = fut.get();
+            if (r.found) bc.chain.push_back(move(r.block));
+        }
+    }
+
     bc.showChain();
     return 0;
 }
+#endif
 
@@ -148,18 +148,50 @@ struct SimpleBlockchain {
         chain.push_back(g);
     }
 
-    pair<Block, uint64_t> mine_next(const string& data) {
+    // Next block on top of the current tip, not yet mined.
+    Block make_template(const string& data) const {
         Block b;
         b.index = chain.size();
         b.prev_hash = chain.back().hash;
         b.data = data;
         b.timestamp = now_iso8601();
-        uint64_t iters = 0;
+        return b;
+    }
+
+    // Moves a template built ahead of time onto the current tip.
+    void link_to_tip(Block& b) const {
+        b.index = chain.size();
+        b.prev_hash = chain.back().hash;
+    }
+
+    // Hashing and difficulty settings without the chain, so that another
+    // thread can mine while this chain keeps growing.
+    SimpleBlockchain params() const {
+        SimpleBlockchain p;
+        p.mode = mode;
+        p.ac_rule = ac_rule;
+        p.ac_steps = ac_steps;
+        p.difficulty_prefix_zeros = difficulty_prefix_zeros;
+        return p;
+    }
+
+    // Searches a nonce for b. Returns false if *cancel was raised before a
+    // valid hash was found (checked between two hashes).
+    bool mine(Block& b, uint64_t& iters, const atomic<bool>* cancel = nullptr) const {
+        iters = 0;
         b.hash = compute_hash(b);
         while (!valid_hash(b.hash)) {
+            if (cancel && cancel->load(memory_order_relaxed)) return false;
             b.nonce++; iters++;
             b.hash = compute_hash(b);
         }
+        return true;
+    }
+
+    pair<Block, uint64_t> mine_next(const string& data) {
+        Block b = make_template(data);
+        uint64_t iters = 0;
+        mine(b, iters);
         return {b, iters};
     }
 
@@ -175,6 +207,518 @@ struct SimpleBlockchain {
     }
 };
 
+// Background Mining Service
+// A worker thread mines the latest submitted template while the caller keeps
+// accepting transactions, validating blocks and building the next template.
+// Submitting a new template (new tip / better template) or calling cancel()
+// aborts the job in flight; its future then resolves with found == false.
+// Each job carries a copy of the chain's mining parameters, taken at submit.
+struct MiningService {
+    struct Result {
+        bool found = false;
+        Block block;
+        uint64_t iters = 0;
+    };
+
+    MiningService() {
+        worker = thread([this] { run(); });
+    }
+
+    ~MiningService() {
+        {
+            lock_guard<mutex> lk(m);
+            stopping = true;
+            if (current) current->store(true);
+        }
+        cv.notify_one();
+        worker.join();
+    }
+
+    MiningService(const MiningService&) = delete;
+    MiningService& operator=(const MiningService&) = delete;
+
+    future<Result> submit(Block tmpl, const SimpleBlockchain& bc) {
+        Job job;
+        job.tmpl = move(tmpl);
+        job.params = bc.params();
+        job.cancel = make_shared<atomic<bool>>(false);
+        future<Result> f = job.done.get_future();
+        {
+            lock_guard<mutex> lk(m);
+            drop_locked();
+            current = job.cancel;
+            pending = make_unique<Job>(move(job));
+        }
+        cv.notify_one();
+        return f;
+    }
+
+    void cancel() {
+        lock_guard<mutex> lk(m);
+        drop_locked();
+    }
+
+    // Blocks until the worker is hashing the latest submitted template.
+    void wait_until_mining() {
+        unique_lock<mutex> lk(m);
+        started.wait(lk, [this] { return mining && !pending; });
+    }
+
+private:
+    struct Job {
+        Block tmpl;
+        SimpleBlockchain params;
+        shared_ptr<atomic<bool>> cancel;
+        promise<Result> done;
+    };
+
+    void drop_locked() {
+        if (current) current->store(true);
+        if (pending) {
+            pending->done.set_value(Result{false, move(pending->tmpl), 0});
+            pending.reset();
+        }
+    }
+
+    void run() {
+        for (;;) {
+            unique_ptr<Job> job;
+            {
+                unique_lock<mutex> lk(m);
+                cv.wait(lk, [this] { return stopping || pending; });
+                if (stopping) break;
+                job = move(pending);
+                mining = true;
+            }
+            started.notify_all();
+            Result r;
+            r.block = move(job->tmpl);
+            r.found = job->params.mine(r.block, r.iters, job->cancel.get());
+            {
+                lock_guard<mutex> lk(m);
+                mining = false;
+            }
+            job->done.set_value(move(r));
+        }
+        lock_guard<mutex> lk(m);
+        if (pending) pending->done.set_value(Result{false, move(pending->tmpl), 0});
+    }
+
+    mutex m;
+    condition_variable cv;
+    condition_variable started;
+    unique_ptr<Job> pending;
+    shared_ptr<atomic<bool>> current;
+    bool stopping = false;
+    bool mining = false;
+    thread worker;
+};
+
+
+// Network Simulation
+// Deterministic discrete-event simulator: N nodes in one process, each with its
+// own SimpleBlockchain, gossiping blocks and transactions over links with a
+// fixed latency and a bandwidth (messages on a link are serialized, so large
+// blocks queue behind each other and behind transaction traffic).
+// Transactions are relayed in batches every tx_flush_ms, like inv trickling.
+// Fork resolution is longest chain, first seen wins on ties.
+enum class Consensus { POW, POS };
+
+struct NetSimConfig {
+    int nodes = 100;
+    int peers = 4;                  // outgoing links per node (links are two-way)
+    double latency_min_ms = 20;
+    double latency_max_ms = 100;
+    double bandwidth_kBps = 1000;   // per link and direction
+    Consensus consensus = Consensus::POW;
+    double block_interval_ms = 2000; // PoW: mean time between blocks, PoS: slot length
+    int difficulty = 2;             // real PoW done by the producer (PoS uses 0)
+    size_t block_txs = 200;         // max transactions per block
+    double tx_per_s = 100;
+    double tx_flush_ms = 100;
+    int tx_bytes = 250;
+    int header_bytes = 80;
+    double duration_s = 600;
+    uint64_t seed = 1;
+};
+
+struct NetSimReport {
+    size_t produced = 0;            // blocks produced, genesis excluded
+    size_t main_chain = 0;          // of which on the final best chain
+    double orphan_rate = 0;
+    size_t samples = 0;             // (block, node) deliveries behind the percentiles
+    double p50_ms = 0, p90_ms = 0, p99_ms = 0; // block delivery latency per node
+    double tps = 0;                 // transactions confirmed on the best chain per second
+    double agreement = 0;           // nodes on the most common tip when production stops
+    bool chains_valid = true;
+    uint64_t events = 0;
+    double wall_s = 0;
+};
+
+class NetworkSimulator {
+public:
+    explicit NetworkSimulator(const NetSimConfig& cfg) : cfg(cfg), rng(cfg.seed) {}
+
+    NetSimReport run() {
+        auto wall0 = chrono::steady_clock::now();
+        build_genesis();
+        build_nodes();
+
+        double end_ms = cfg.duration_s * 1000;
+        if (cfg.tx_per_s > 0)
+            schedule(exponential(1000 / cfg.tx_per_s), NEW_TX, pick_uniform(), -1, -1);
+        schedule(next_block_delay(), PRODUCE, -1, -1, -1);
+        schedule(end_ms, MEASURE, -1, -1, -1);
+
+        // Production stops at end_ms; in-flight messages are drained so that
+        // the network settles before the final chain is measured.
+        while (!events.empty()) {
+            Event e = events.top(); events.pop();
+            now = e.t;
+            ++report.events;
+            switch (e.type) {
+            case NEW_TX:
+                if (now > end_ms) break;
+                new_tx(e.node);
+                schedule(now + exponential(1000 / cfg.tx_per_s), NEW_TX, pick_uniform(), -1, -1);
+                break;
+            case PRODUCE:
+                if (now > end_ms) break;
+                produce(pick_weighted());
+                schedule(now + next_block_delay(), PRODUCE, -1, -1, -1);
+                break;
+            case FLUSH_TX:
+                flush_tx(e.node);
+                break;
+            case RECV_TX:
+                recv_tx(e.node, e.item);
+                break;
+            case RECV_BLOCK:
+                recv_block(e.node, e.from, e.item);
+                break;
+            case MEASURE:
+                measure_agreement();
+                break;
+            }
+        }
+        finish();
+        report.wall_s = chrono::duration<double>(chrono::steady_clock::now() - wall0).count();
+        return report;
+    }
+
+private:
+    enum EventType { NEW_TX, PRODUCE, FLUSH_TX, RECV_TX, RECV_BLOCK, MEASURE };
+
+    struct Event {
+        double t;
+        uint64_t seq;               // FIFO among equal times, keeps runs reproducible
+        EventType type;
+        int node, from, item;
+        bool operator>(const Event& o) const {
+            return t != o.t ? t > o.t : seq > o.seq;
+        }
+    };
+
+    struct Link {
+        int to;
+        double latency_ms;
+        double busy_until = 0;
+    };
+
+    struct SimBlock {
+        Block block;
+        int parent;
+        size_t height;
+        double created_ms;
+        vector<uint32_t> txs;
+    };
+
+    // Transaction batch in flight; released once every link delivered it.
+    struct TxBatch {
+        vector<uint32_t> ids;
+        int in_flight = 0;
+    };
+
+    enum BlockState : uint8_t { UNKNOWN, WAITING, CONNECTED };
+    enum TxState : uint8_t { UNSEEN, PENDING, CONFIRMED };
+
+    struct Node {
+        SimpleBlockchain bc;        // active chain, rewritten on reorg
+        vector<int> active;         // block ids parallel to bc.chain
+        vector<Link> links;
+        vector<uint8_t> state;      // BlockState per block id
+        unordered_map<int, vector<int>> waiting; // parent id -> orphans
+        vector<uint8_t> tx;         // TxState per tx id (ids are dense)
+        size_t mempool_low = 0;     // every tx below this id is confirmed
+        vector<uint32_t> outbox;    // txs to relay at the next flush
+        bool flush_scheduled = false;
+        double weight = 1;          // hash rate (PoW) or stake (PoS)
+    };
+
+    const NetSimConfig cfg;
+    mt19937_64 rng;
+    priority_queue<Event, vector<Event>, greater<Event>> events;
+    uint64_t seq = 0;
+    double now = 0;
+    vector<SimBlock> blocks;        // shared, immutable once produced
+    vector<TxBatch> batches;
+    vector<int> free_batches;
+    vector<Node> nodes;
+    double total_weight = 0;
+    uint32_t next_tx = 0;
+    vector<double> delivery_ms;
+    NetSimReport report;
+
+    double exponential(double mean) {
+        return exponential_distribution<double>(1 / mean)(rng);
+    }
+
+    double next_block_delay() {
+        return cfg.consensus == Consensus::POW ? exponential(cfg.block_interval_ms)
+                                               : cfg.block_interval_ms;
+    }
+
+    int pick_uniform() {
+        return uniform_int_distribution<int>(0, cfg.nodes - 1)(rng);
+    }
+
+    // Block producer chosen proportionally to hash rate (PoW) or stake (PoS).
+    int pick_weighted() {
+        double r = uniform_real_distribution<double>(0, total_weight)(rng);
+        for (int i = 0; i < cfg.nodes; ++i) {
+            if (r < nodes[i].weight) return i;
+            r -= nodes[i].weight;
+        }
+        return cfg.nodes - 1;
+    }
+
+    void schedule(double t, EventType type, int node, int from, int item) {
+        events.push(Event{t, seq++, type, node, from, item});
+    }
+
+    void send(int node, Link& l, EventType type, int item, size_t bytes) {
+        double depart = max(now, l.busy_until);
+        l.busy_until = depart + bytes / cfg.bandwidth_kBps; // 1 kB/s == 1 byte/ms
+        schedule(l.busy_until + l.latency_ms, type, l.to, node, item);
+    }
+
+    size_t block_bytes(int id) const {
+        return cfg.header_bytes + blocks[id].txs.size() * cfg.tx_bytes;
+    }
+
+    void build_genesis() {
+        SimpleBlockchain proto;
+        proto.difficulty_prefix_zeros = difficulty();
+        Block g{0, string(64, '0'), "Genesis", 0, "t=0", ""};
+        uint64_t iters = 0;
+        proto.mine(g, iters);
+        blocks.push_back(SimBlock{g, -1, 0, 0, {}});
+    }
+
+    int difficulty() const {
+        return cfg.consensus == Consensus::POW ? cfg.difficulty : 0;
+    }
+
+    // Random graph: a spanning tree (node i links to an earlier node) keeps it
+    // connected, then extra random links up to `peers` per node.
+    void build_nodes() {
+        nodes.resize(cfg.nodes);
+        uniform_real_distribution<double> lat(cfg.latency_min_ms, cfg.latency_max_ms);
+        uniform_real_distribution<double> w(1, 10);
+        set<pair<int,int>> edges;
+        auto connect = [&](int a, int b) {
+            if (a == b || !edges.insert({min(a, b), max(a, b)}).second) return;
+            double l = lat(rng);
+            nodes[a].links.push_back(Link{b, l});
+            nodes[b].links.push_back(Link{a, l});
+        };
+        for (int i = 1; i < cfg.nodes; ++i)
+            connect(i, uniform_int_distribution<int>(0, i - 1)(rng));
+        for (int i = 0; i < cfg.nodes; ++i)
+            for (int k = 1; k < cfg.peers; ++k)
+                connect(i, pick_uniform());
+
+        for (auto& n : nodes) {
+            n.bc.difficulty_prefix_zeros = difficulty();
+            n.bc.chain.push_back(blocks[0].block);
+            n.active.push_back(0);
+            n.state.push_back(CONNECTED);
+            n.weight = w(rng);
+            total_weight += n.weight;
+        }
+    }
+
+    uint8_t& tx_state(Node& n, uint32_t id) {
+        if (n.tx.size() <= id) n.tx.resize(next_tx, UNSEEN);
+        return n.tx[id];
+    }
+
+    void new_tx(int node) {
+        uint32_t id = next_tx++;
+        see_tx(node, id);
+    }
+
+    void see_tx(int node, uint32_t id) {
+        Node& n = nodes[node];
+        uint8_t& st = tx_state(n, id);
+        if (st != UNSEEN) return;
+        st = PENDING;
+        n.outbox.push_back(id);
+        if (!n.flush_scheduled) {
+            n.flush_scheduled = true;
+            schedule(now + cfg.tx_flush_ms, FLUSH_TX, node, -1, -1);
+        }
+    }
+
+    void flush_tx(int node) {
+        Node& n = nodes[node];
+        n.flush_scheduled = false;
+        if (n.outbox.empty()) return;
+        int id;
+        if (free_batches.empty()) {
+            id = (int)batches.size();
+            batches.emplace_back();
+        } else {
+            id = free_batches.back();
+            free_batches.pop_back();
+        }
+        TxBatch& b = batches[id];
+        b.ids.swap(n.outbox);
+        n.outbox.clear();
+        b.in_flight = (int)n.links.size();
+        size_t bytes = b.ids.size() * cfg.tx_bytes;
+        for (auto& l : n.links) send(node, l, RECV_TX, id, bytes);
+    }
+
+    void recv_tx(int node, int batch) {
+        TxBatch& b = batches[batch];
+        for (uint32_t t : b.ids) see_tx(node, t);
+        if (--b.in_flight == 0) free_batches.push_back(batch);
+    }
+
+    void produce(int node) {
+        Node& n = nodes[node];
+        int parent = n.active.back();
+        SimBlock sb;
+        sb.parent = parent;
+        sb.height = blocks[parent].height + 1;
+        sb.created_ms = now;
+        while (n.mempool_low < n.tx.size() && n.tx[n.mempool_low] == CONFIRMED)
+            ++n.mempool_low;
+        for (size_t t = n.mempool_low; t < n.tx.size() && sb.txs.size() < cfg.block_txs; ++t)
+            if (n.tx[t] == PENDING) sb.txs.push_back((uint32_t)t);
+
+        // The block commits to its transaction list through a digest, like a
+        // header's Merkle root, so that relaying nodes only hash a header.
+        string ids;
+        for (uint32_t t : sb.txs) ids += to_string(t) + ",";
+        string data = "node=" + to_string(node) + ";ntx=" + to_string(sb.txs.size()) +
+                      ";txs=" + SHA256::hash(ids);
+        sb.block = Block{(int)sb.height, blocks[parent].block.hash, data, 0,
+                         "t=" + to_string((long long)now), ""};
+        uint64_t iters = 0;
+        n.bc.mine(sb.block, iters);
+        blocks.push_back(move(sb));
+        ++report.produced;
+        recv_block(node, -1, (int)blocks.size() - 1);
+    }
+
+    void recv_block(int node, int from, int id) {
+        Node& n = nodes[node];
+        if ((size_t)id < n.state.size() && n.state[id] != UNKNOWN) return;
+        if (n.state.size() < blocks.size()) n.state.resize(blocks.size(), UNKNOWN);
+
+        const SimBlock& sb = blocks[id];
+        if (n.bc.compute_hash(sb.block) != sb.block.hash || !n.bc.valid_hash(sb.block.hash) ||
+            sb.block.prev_hash != blocks[sb.parent].block.hash)
+            return;
+        if (from >= 0) delivery_ms.push_back(now - sb.created_ms);
+
+        n.state[id] = WAITING;
+        size_t bytes = block_bytes(id);
+        for (auto& l : n.links)
+            if (l.to != from) send(node, l, RECV_BLOCK, id, bytes);
+
+        if (n.state[sb.parent] != CONNECTED) {
+            n.waiting[sb.parent].push_back(id);
+            return;
+        }
+        vector<int> ready{id};
+        while (!ready.empty()) {
+            int b = ready.back(); ready.pop_back();
+            n.state[b] = CONNECTED;
+            if (blocks[b].height > blocks[n.active.back()].height) reorg(n, b);
+            auto it = n.waiting.find(b);
+            if (it != n.waiting.end()) {
+                ready.insert(ready.end(), it->second.begin(), it->second.end());
+                n.waiting.erase(it);
+            }
+        }
+    }
+
+    // Switches the active chain to end at `tip`. Transactions of disconnected
+    // blocks go back to the mempool (they were seen, so they are not relayed).
+    void reorg(Node& n, int tip) {
+        vector<int> branch;
+        int b = tip;
+        while (!(blocks[b].height < n.active.size() && n.active[blocks[b].height] == b)) {
+            branch.push_back(b);
+            b = blocks[b].parent;
+        }
+        size_t keep = blocks[b].height + 1;
+        while (n.active.size() > keep) {
+            for (uint32_t t : blocks[n.active.back()].txs) {
+                n.tx[t] = PENDING;
+                n.mempool_low = min<size_t>(n.mempool_low, t);
+            }
+            n.active.pop_back();
+            n.bc.chain.pop_back();
+        }
+        for (auto it = branch.rbegin(); it != branch.rend(); ++it) {
+            for (uint32_t t : blocks[*it].txs) tx_state(n, t) = CONFIRMED;
+            n.active.push_back(*it);
+            n.bc.chain.push_back(blocks[*it].block);
+        }
+    }
+
+    // Taken when production stops, before the drain lets every node catch up.
+    void measure_agreement() {
+        unordered_map<int, size_t> tips;
+        size_t most = 0;
+        for (auto& n : nodes) most = max(most, ++tips[n.active.back()]);
+        report.agreement = (double)most / nodes.size();
+    }
+
+    static double percentile(const vector<double>& sorted, double p) {
+        if (sorted.empty()) return 0;
+        return sorted[(size_t)(p * (sorted.size() - 1))];
+    }
+
+    void finish() {
+        int best = 0;
+        for (auto& n : nodes)
+            if (blocks[n.active.back()].height > blocks[best].height) best = n.active.back();
+
+        size_t confirmed = 0;
+        for (int b = best; b > 0; b = blocks[b].parent) {
+            ++report.main_chain;
+            confirmed += blocks[b].txs.size();
+        }
+        report.orphan_rate = report.produced
+            ? 1.0 - (double)report.main_chain / report.produced : 0;
+        report.tps = confirmed / cfg.duration_s;
+
+        for (auto& n : nodes)
+            report.chains_valid = report.chains_valid && n.bc.validate_chain();
+
+        sort(delivery_ms.begin(), delivery_ms.end());
+        report.samples = delivery_ms.size();
+        report.p50_ms = percentile(delivery_ms, 0.50);
+        report.p90_ms = percentile(delivery_ms, 0.90);
+        report.p99_ms = percentile(delivery_ms, 0.99);
+    }
+};
+
 
 // Analysis & Tests
 struct Timer {
@@ -219,9 +763,47 @@ double bit_distribution(uint32_t rule, size_t steps) {
     return 100.0 * ones / total;
 }
 
+// Network scaling sweep (./workshop --netsim-sweep)
+// Transaction load follows the block size so that blocks are full.
+void netsim_sweep() {
+    cout << fixed << "Network simulation (SHA256, 600 s simulated, full blocks)\n"
+         << "  cons nodes maxtx | blocks stale orphan%  samples  p50ms  p90ms  p99ms"
+            "    tps agree% valid   wall\n";
+    auto sim_row = [](Consensus c, int n, size_t txs) {
+        NetSimConfig cfg;
+        cfg.consensus = c;
+        cfg.nodes = n;
+        cfg.block_txs = txs;
+        cfg.tx_per_s = txs * 1000 / cfg.block_interval_ms;
+        NetSimReport r = NetworkSimulator(cfg).run();
+        cout << "  " << (c == Consensus::POW ? "PoW " : "PoS ")
+             << setw(5) << n << setw(6) << txs << " |"
+             << setw(7) << r.produced
+             << setw(6) << r.produced - r.main_chain
+             << setw(8) << setprecision(1) << r.orphan_rate * 100
+             << setw(9) << r.samples
+             << setw(7) << setprecision(0) << r.p50_ms
+             << setw(7) << r.p90_ms << setw(7) << r.p99_ms
+             << setw(7) << setprecision(1) << r.tps
+             << setw(7) << setprecision(0) << r.agreement * 100
+             << setw(6) << (r.chains_valid ? "yes" : "no")
+             << setw(6) << setprecision(2) << r.wall_s << "s\n";
+    };
+    for (int n : {50, 100, 200, 400})
+        for (size_t txs : {50, 200, 800})
+            sim_row(Consensus::POW, n, txs);
+    for (int n : {50, 100, 200, 400})
+        sim_row(Consensus::POS, n, 800);
+}
+
 // Main
 
-int main() {
+int main(int argc, char** argv) {
+    if (argc > 1 && string(argv[1]) == "--netsim-sweep") {
+        netsim_sweep();
+        return 0;
+    }
+
     cout << "Testing AC_HASH and Blockchain integration...\n\n";
 
     cout << "ac_hash('hello', rule=30, steps=128) = "
@@ -235,6 +817,53 @@ int main() {
     bc.chain.push_back(blk);
     cout << "Blockchain valid? " << (bc.validate_chain() ? "YES" : "NO") << "\n\n";
 
+    cout << "Asynchronous mining (SHA256, difficulty 4)...\n";
+    SimpleBlockchain sbc;
+    sbc.add_genesis();
+    {
+        MiningService miner;
+        auto stale = miner.submit(sbc.make_template("Block 1 (stale)"), sbc);
+        miner.wait_until_mining();
+        // A better template arrives while the worker is hashing the first one.
+        Timer tc; tc.start();
+        auto fut = miner.submit(sbc.make_template("Block 1"), sbc);
+        auto s = stale.get();
+        double cancel_us = tc.stop_s() * 1e6;
+        miner.wait_until_mining();
+        double restart_us = tc.stop_s() * 1e6;
+        cout << "Stale job " << (s.found ? "finished before cancel" : "cancelled")
+             << " after " << s.iters << " hashes: cancel " << fixed << setprecision(1)
+             << cancel_us << " us, restart " << restart_us << " us\n";
+
+        for (int i = 2; i <= 5; ++i) {
+            // Template built while the worker is still mining the previous
+            // block, then relinked once that block becomes the tip.
+            Block next = sbc.make_template("Block " + to_string(i));
+            auto r = fut.get();
+            if (!r.found) break; // cancelled: the template was not mined
+            sbc.chain.push_back(move(r.block));
+            sbc.link_to_tip(next);
+            fut = miner.submit(move(next), sbc);
+        }
+        if (fut.valid()) {
+            auto r = fut.get();
+            if (r.found) sbc.chain.push_back(move(r.block));
+        }
+    }
+    cout << "Mined " << sbc.chain.size() - 1 << " blocks, chain valid? "
+         << (sbc.validate_chain() ? "YES" : "NO") << "\n\n";
+
+    // Small run to exercise the simulator; the scaling sweep is behind
+    // --netsim-sweep.
+    NetSimConfig sim;
+    sim.nodes = 50;
+    sim.duration_s = 60;
+    NetSimReport sr = NetworkSimulator(sim).run();
+    cout << "Network simulation (50 nodes, 60 s): " << sr.produced << " blocks, "
+         << sr.samples << " deliveries, p90 " << setprecision(0) << sr.p90_ms
+         << " ms, chains valid? " << (sr.chains_valid ? "YES" : "NO") << "\n\n";
+    if (!sr.chains_valid || sr.samples == 0) return 1;
+
     cout << "Avalanche effect (Rule 30): "
          << fixed << setprecision(2)
          << avalanche_test(30, 128) / 256 * 100 << "% bits changed\n";